@@ -41,6 +41,9 @@ void setup()
     // The DFRobot device is factory-set for 115200 baud
     sensorSerial.begin( 115200 );
   #endif
+
+  // Turn off command echoing so there's less for the library to read back
+  sensor.begin();
   
   // Restore to the factory settings -- it's not necessary to do this unless needed
   sensor.factoryReset();
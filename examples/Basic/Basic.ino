@@ -25,6 +25,9 @@ void setup()
   
   // The DFRobot device is factory-set for 115200 baud
   Serial1.begin( 115200 );
+
+  // Turn off command echoing so there's less for the library to read back
+  sensor.begin();
   
   // Restore to the factory settings -- it's not necessary to do this unless needed
   sensor.factoryReset();
@@ -0,0 +1,76 @@
+/**
+ * DFR_Radar: EventLog.ino
+ *
+ * This example keeps a log of every time presence starts or stops, and
+ * once a minute packs the last minute's worth into a tiny binary frame,
+ * which is how you might report occupancy over a low-bandwidth link
+ * such as LoRa.  Here the frame is just printed out in hex.
+ *
+ * Presence is read from the sensor's IO2 output, but you could just as
+ * well use `sensor.checkPresence()`.
+ *
+ * The same DFR_RadarEventLog.h header has the `DFR_RadarEventFrame`
+ * decoder, which can be used on the receiving end to turn the frames
+ * back into a timeline.
+ *
+ * Created 18 October 2026
+ * By the DFR_Radar contributors
+ */
+
+#include <DFR_Radar.h>
+#include <DFR_RadarEventLog.h>
+
+// Serial1 is the hardware UART pins
+DFR_Radar sensor( &Serial1 );
+
+// IO2 from sensor is connected to pin 3 on the Arduino
+const int TRIGGER_INPUT = 3;
+
+// Send a frame once a minute
+const unsigned long REPORT_INTERVAL = 60000;
+
+// Keep up to 32 transitions (128 bytes)
+DFR_RadarEventLog<32> eventLog;
+
+unsigned long lastReport = 0;
+
+void setup()
+{
+  Serial.begin( 9600 );
+
+  // The DFRobot device is factory-set for 115200 baud
+  Serial1.begin( 115200 );
+
+  // Configure the digital input used to detect presence triggers
+  pinMode( TRIGGER_INPUT, INPUT );
+
+  // Make IO2 follow presence without any extra delay
+  sensor.setOutputLatency( 0, 0 );
+}
+
+void loop()
+{
+  unsigned long now = millis();
+
+  // Only changes are actually stored, so it's fine to do this constantly
+  eventLog.record( digitalRead( TRIGGER_INPUT ), now );
+
+  if( now - lastReport < REPORT_INTERVAL )
+    return;
+
+  // One byte of header plus typically one or two bytes per transition
+  uint8_t frame[16];
+  size_t length = eventLog.serialize( lastReport, now, frame, sizeof( frame ), DFR_RadarEventFrame::resolution1s );
+
+  for( size_t i = 0; i < length; i++ )
+  {
+    if( frame[i] < 0x10 )
+      Serial.print( '0' );
+
+    Serial.print( frame[i], HEX );
+  }
+
+  Serial.println();
+
+  lastReport = now;
+}
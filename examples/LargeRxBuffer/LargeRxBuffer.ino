@@ -0,0 +1,113 @@
+/**
+ * DFR_Radar: LargeRxBuffer.ino
+ *
+ * This example puts a larger receive buffer between the UART and the
+ * library, so that the sensor's responses aren't lost while the sketch
+ * is busy doing something else.
+ *
+ * The standard 64-byte buffer on AVR boards fills up in about 5ms at
+ * 115200 baud, after which anything else the sensor sends is lost, and
+ * the next command may have to wait out its timeout.
+ *
+ * On classic AVR boards (Mega, Leonardo, etc.) the buffer is filled from
+ * a 1ms timer interrupt, so it keeps up no matter what the sketch is
+ * doing.  This borrows Timer0's compare A interrupt -- Timer0 is already
+ * running for `millis()`, so this doesn't change its timing, but it does
+ * take over PWM on Timer0's OC0A pin (pin 13 on a Mega).
+ *
+ * Elsewhere it's filled by polling from `yield()`, which only runs while
+ * in `delay()`, so the busy loop below will let Serial1's own buffer fill
+ * up there.
+ *
+ * When motion is detected, it will turn on the built-in LED.
+ *
+ * Created 18 October 2026
+ * By the DFR_Radar contributors
+ */
+
+#include <DFR_Radar.h>
+#include <DFR_RadarRxBuffer.h>
+
+#if defined( __AVR__ ) && defined( TIMSK0 ) && defined( OCIE0A )
+  #define FILL_FROM_TIMER
+#endif
+
+// Size of Serial1's own receive buffer, so the ring can tell when it fills up
+#ifdef SERIAL_RX_BUFFER_SIZE
+  const size_t UART_BUFFER_SIZE = SERIAL_RX_BUFFER_SIZE;
+#else
+  const size_t UART_BUFFER_SIZE = 0; // Not known for this core, so don't check
+#endif
+
+#ifdef FILL_FROM_TIMER
+  // Buffer up to 255 bytes received on Serial1, filled from the timer interrupt below
+  DFR_RadarRxBuffer<256> sensorRx( &Serial1, true, UART_BUFFER_SIZE );
+
+  // Fires once per millisecond, part way through each Timer0 count
+  ISR( TIMER0_COMPA_vect )
+  {
+    sensorRx.poll();
+  }
+#else
+  // Buffer up to 255 bytes received on Serial1, filled whenever the sketch reads from it
+  DFR_RadarRxBuffer<256> sensorRx( &Serial1, false, UART_BUFFER_SIZE );
+
+  #ifndef ESP32
+    // `delay()` calls `yield()` over and over while it waits, so use that
+    // to keep moving data out of the UART before it overflows
+    void yield()
+    {
+      sensorRx.poll();
+    }
+  #endif
+#endif
+
+// Hand the buffer to DFR_Radar in place of Serial1
+DFR_Radar sensor( &sensorRx );
+
+void setup()
+{
+  Serial.begin( 9600 );
+
+  #ifdef ESP32
+    // The ESP32's UART driver can buffer more by itself
+    Serial1.setRxBufferSize( 1024 );
+  #endif
+
+  // The DFRobot device is factory-set for 115200 baud
+  Serial1.begin( 115200 );
+
+  #ifdef FILL_FROM_TIMER
+    OCR0A = 0x80;
+    TIMSK0 |= _BV( OCIE0A );
+  #endif
+
+  // Turn off command echoing so there's less for the library to read back
+  sensor.begin();
+
+  // Setup the built-in LED
+  pinMode( LED_BUILTIN, OUTPUT );
+}
+
+void loop()
+{
+  // Query the presence detection status
+  bool presence = sensor.checkPresence();
+
+  // If presence == true, turn on the built-in LED.
+  digitalWrite( LED_BUILTIN, presence );
+
+  // Bytes dropped because the ring was full, and the number of times Serial1's
+  // own buffer was found full (so the core may have dropped some itself)
+  Serial.print( presence );
+  Serial.print( "  overruns: " );
+  Serial.print( sensorRx.overruns() );
+  Serial.print( "  UART full: " );
+  Serial.println( sensorRx.uartFullCount() );
+
+  // Pretend to be busy with something that doesn't call `yield()`...
+  delayMicroseconds( 15000 );
+
+  // ...and then with something that does
+  delay( 500 );
+}
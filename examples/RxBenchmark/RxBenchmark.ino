@@ -0,0 +1,119 @@
+/**
+ * DFR_Radar: RxBenchmark.ino
+ *
+ * This example measures how quickly the library can take in and parse
+ * responses from the sensor, without a sensor attached.  It replays
+ * replies to `getOutput 1` from memory, so the numbers reflect only the
+ * CPU time spent reading and parsing, not time spent waiting on the UART.
+ *
+ * The replies are synthetic: they're written out by hand in the format
+ * the sensor uses, not captured from one.  To benchmark real traffic,
+ * paste in what your own sensor sends back instead.
+ *
+ * Both sets of replies are run: one with command echoing on (factory
+ * default) and one with it off (what `begin()` sets up).
+ *
+ * Created 18 October 2026
+ * By the DFR_Radar contributors
+ */
+
+#include <DFR_Radar.h>
+
+// Synthetic replies to `getOutput 1`, with and without the command echoed back
+const char echoOnReplies[]  = "getOutput 1\r\nDone\r\nleapMMW:/>$JYBSS,1, , , *\r\n";
+const char echoOffReplies[] = "Done\r\n$JYBSS,1, , , *\r\n";
+
+// How many times to run `checkPresence()` for each set of replies
+const unsigned long ITERATIONS = 1000;
+
+
+/**
+ * A Stream that plays back the same replies every time it receives a command
+ */
+class ReplayStream : public Stream
+{
+  public:
+
+    ReplayStream( const char *replies ) :
+      bytesRead( 0 ), data( replies ), length( strlen( replies ) ), position( length )
+    {}
+
+    int available()
+    {
+      return length - position;
+    }
+
+    int read()
+    {
+      if( position >= length )
+        return -1;
+
+      bytesRead++;
+      return data[position++];
+    }
+
+    int peek()
+    {
+      return position < length ? data[position] : -1;
+    }
+
+    size_t write( uint8_t c )
+    {
+      // The end of a command starts the reply
+      if( c == '\n' )
+        position = 0;
+
+      return 1;
+    }
+
+    void flush()
+    {}
+
+    unsigned long bytesRead;
+
+  private:
+
+    const char *data;
+    size_t length;
+    size_t position;
+};
+
+
+void benchmark( const char *name, const char *replies )
+{
+  ReplayStream replay( replies );
+  DFR_Radar sensor( &replay );
+  unsigned long detected = 0;
+
+  unsigned long startTime = micros();
+
+  for( unsigned long i = 0; i < ITERATIONS; i++ )
+    detected += sensor.checkPresence();
+
+  unsigned long elapsed = micros() - startTime;
+
+  Serial.print( name );
+  Serial.print( ": " );
+  Serial.print( (float)elapsed / ITERATIONS );
+  Serial.print( " us per reading, " );
+  Serial.print( replay.bytesRead * 1000000.0 / elapsed, 0 );
+  Serial.print( " bytes/s, " );
+  Serial.print( detected );
+  Serial.print( "/" );
+  Serial.print( ITERATIONS );
+  Serial.println( " detected" );
+}
+
+void setup()
+{
+  Serial.begin( 9600 );
+
+  while( !Serial )
+    ;
+
+  benchmark( "Echo on ", echoOnReplies );
+  benchmark( "Echo off", echoOffReplies );
+}
+
+void loop()
+{}
@@ -14,17 +14,51 @@
 #include <DFR_Radar.h>
 
 
+// Bytes we expect back for each command class: the echo, "Done", and the
+// prompt, plus the $JYBSS data for a query or an "already" message for control
+const uint8_t DFR_Radar::responseLength[classCount] = { 48, 64, 48, 40, 40 };
+
+// These are the fixed timeouts the library has always used; each class starts out at
+// its limit and only gets shorter once we've measured how quickly the sensor responds,
+// so a sensor that isn't there at all never costs more than it used to
+const uint16_t DFR_Radar::maxTimeout[classCount] = { readPacketTimeout, comTimeout, comTimeout, comTimeout, comTimeout };
+
+
 DFR_Radar::DFR_Radar( Stream *s )
 {
   sensorUART = s;
+  rxStart = rxLength = 0;
   // isConfigured = false;
   stopped = false;
   multiConfig = false;
+
+  savePending = false;
+  saveFailed = false;
+  saveWindow = 0;
+  savePendingSince = 0;
+
+  config.flags = 0;
+
+  heartbeatTimeout = 0;
+  lastHeartbeat = 0;
+  reportOffset = 0;
+  recoveryCallback = NULL;
+  recoveryBackoff = 0;
+  lastRecovery = 0;
+
+  // Factory default is command echoing on
+  echo = true;
+
+  baudRate = defaultBaudRate;
+  resetTimeouts();
 }
 
 bool DFR_Radar::begin()
 {
-  /* Not sure if I want to impliment this, keeping it for future consideration...
+  // Disable command echoing (less response data that we have to parse through)
+  return setEcho( false );
+
+  /* Not sure if I want to impliment the rest, keeping it for future consideration...
 
   unsigned long startTime = millis() + startupDelay;
 
@@ -46,9 +80,6 @@ bool DFR_Radar::begin()
   if( !stop() )
     return false;
 
-  // Disable command echoing (less response data that we have to parse through)
-  sendCommand( comSetEcho );
-
   // Disable periodic $JYBSS messages (we will query for them)
   sendCommand( comSetUartOutput );
 
@@ -61,49 +92,124 @@ bool DFR_Radar::begin()
   isConfigured = true;
 
   */
-
-  return true;
 }
 
 void DFR_Radar::setStream( Stream *s ) {
     sensorUART = s;
 }
 
+void DFR_Radar::setBaudRate( uint32_t baud ) {
+    baudRate = baud ? baud : defaultBaudRate;
+    resetTimeouts();
+}
+
 bool DFR_Radar::isReady() {
     return sensorUART != nullptr;
 }
 
-size_t DFR_Radar::readLines( char *buffer, size_t lineCount )
+size_t DFR_Radar::receive()
 {
-  unsigned long timeLimit = millis() + readPacketTimeout;
-  size_t offset = 0, linesLeft = lineCount;
+  int available = sensorUART->available();
+
+  if( available <= 0 )
+    return 0;
 
-  while( linesLeft && millis() < timeLimit )
+  // Keep room for a null terminator
+  size_t space = sizeof( rxBuffer ) - 1 - rxLength;
+
+  // A line that fills the whole buffer isn't anything we'd recognise anyway
+  if( !space )
   {
-    if( sensorUART->available() <= 0 )
-      continue;
+    rxStart = rxLength = 0;
+    space = sizeof( rxBuffer ) - 1;
+  }
 
-    char c = sensorUART->read();
+  // Take everything that's waiting in one go
+  size_t count = min( (size_t)available, space );
 
-    if( c == '\r' )
-      continue;
+  #if defined( ESP32 ) || defined( ESP8266 )
+    // These cores make `readBytes()` virtual, and their HardwareSerial overrides it to copy
+    // straight out of the UART driver's buffer
+    count = sensorUART->readBytes( rxBuffer + rxLength, count );
+    rxLength += count;
+  #else
+    // Elsewhere `readBytes()` isn't virtual, and is a per-byte `timedRead()` loop that
+    // would call `millis()` for every byte, so a plain `read()` loop is quicker
+    for( size_t i = 0; i < count; i++ )
+    {
+      int c = sensorUART->read();
+
+      if( c < 0 )
+        return i;
+
+      rxBuffer[rxLength++] = c;
+    }
+  #endif
+
+  return count;
+}
+
+char *DFR_Radar::readLine( unsigned long startTime, unsigned long timeout )
+{
+  while( true )
+  {
+    char *line = rxBuffer + rxStart;
+    char *end = (char *)memchr( line, '\n', rxLength - rxStart );
+
+    if( end != NULL )
+    {
+      // Terminate the line in place, dropping the <CR> of the <CRLF> if there is one
+      *end = '\0';
+      if( end > line && end[-1] == '\r' )
+        end[-1] = '\0';
+
+      rxStart = end + 1 - rxBuffer;
 
-    buffer[offset++] = c;
+      return line;
+    }
 
-    if( c == '\n' )
-      linesLeft--;
+    // Only give up after scanning whatever the last pass received
+    if( millis() - startTime >= timeout )
+      return NULL;
+
+    // No complete line yet; move what we have of it to the front to make room for the rest
+    if( rxStart )
+    {
+      rxLength -= rxStart;
+      memmove( rxBuffer, line, rxLength );
+      rxStart = 0;
+    }
+
+    receive();
   }
+}
 
-  return strlen( buffer );
+void DFR_Radar::discardInput()
+{
+  int available;
+
+  // One `available()` per batch rather than per byte
+  while( ( available = sensorUART->available() ) > 0 )
+  {
+    #if defined( ESP32 ) || defined( ESP8266 )
+      // `rxBuffer` is about to be emptied anyway, so use it as somewhere to read into
+      sensorUART->readBytes( rxBuffer, min( (size_t)available, sizeof( rxBuffer ) ) );
+    #else
+      while( available-- )
+        sensorUART->read();
+    #endif
+  }
+
+  rxStart = rxLength = 0;
 }
 
 bool DFR_Radar::checkPresence()
 {
-  char packet[packetLength] = {0};
-
   // Factory default settings have $JYBSS messages sent once per second,
   // but we won't want to wait; this will prompt for status immediately
   serialWrite( comGetOutput );
+  unsigned long startTime = millis(), firstSent = startTime;
+  unsigned long timeout = commandTimeout( classQuery );
 
   /**
    * Get the response immediately after sending the command.
@@ -118,44 +224,80 @@ bool DFR_Radar::checkPresence()
    *   2. the $JYBSS data we want
    *
    * Factory default is command echoing on (might change this in `begin()`)
+   *
+   * A periodic $JYBSS report can also turn up before any of that, so the
+   * data only counts once we've seen the "Done".
    */
-  size_t length = readLines( packet, 3 );
+  bool echoed = false, done = false, retried = false;
+  char *line, *data = NULL, *end = NULL;
 
-  if( !length )
-    return false;
+  while( end == NULL )
+  {
+    line = readLine( startTime, timeout );
 
-  const size_t expectedLength = 16;
-  char data[expectedLength] = {0};
-  uint8_t offset = 0;
-  bool startCharacterFound = false, endCharacterFound = false;
+    if( line == NULL )
+    {
+      backoffTimeout( classQuery );
 
-  /**
-   * Parse through the packet until we find a "$", and
-   * then start capturing characters until we find a "*"
-   *
-   * We're expecting to get something like: $JYBSS,1, , , *
-   */
-  for( uint8_t i = 0; i < length; i++ )
-  {
-    char c = packet[i];
+      // Give it one more chance, in case our timeout was just a bit too keen
+      if( retried || !( timeout = retryTimeout( classQuery, firstSent ) ) )
+        return false;
 
-    if( c == '$' )
-      startCharacterFound = true;
+      retried = true;
+      echoed = done = false;
 
-    if( !startCharacterFound )
+      serialWrite( comGetOutput );
+      startTime = millis();
       continue;
+    }
 
-    if( c == '*' )
-      endCharacterFound = true;
+    // Make sure our idea of the echo state still matches what the sensor is doing; if
+    // the command isn't echoed before the "Done", then echoing must be off (and vice versa)
+    if( !done && strncmp( comGetOutput, line, strlen( comGetOutput ) ) == 0 )
+    {
+      echoed = true;
+      continue;
+    }
 
-    data[offset++] = c;
+    if( !done && strncmp( comResponseSuccess, line, strlen( comResponseSuccess ) ) == 0 )
+    {
+      echo = echoed;
+      done = true;
+      continue;
+    }
 
-    if( endCharacterFound || offset == expectedLength )
+    if( strncmp( comResponseFail, line, strlen( comResponseFail ) ) == 0 )
       break;
+
+    // Anything before the "Done" isn't our reply
+    if( !done )
+      continue;
+
+    /**
+     * Look for a "$", and then a "*" after it
+     *
+     * We're expecting to get something like: $JYBSS,1, , , *
+     */
+    data = strchr( line, '$' );
+
+    if( data != NULL )
+      end = strchr( data, '*' );
   }
 
-  if( !startCharacterFound || !endCharacterFound )
+  if( end == NULL || end - data < 8 )
+  {
+    backoffTimeout( classQuery );
     return false;
+  }
+
+  // After a retry, there's no telling which of the two this is the response to, and
+  // the other one could still be on its way
+  if( !retried )
+    updateTimeout( classQuery, millis() - startTime );
+  else
+    skipResponse( classQuery, firstSent );
+
+  lastHeartbeat = millis();
 
   return ( data[7] == '1' );
 }
@@ -180,7 +322,13 @@ bool DFR_Radar::setLockout( float time )
     sprintf( _comSetInhibit, comSetInhibit, time );
   #endif
 
-  return setConfig( _comSetInhibit );
+  if( !setConfig( _comSetInhibit ) )
+    return false;
+
+  config.lockout = time;
+  config.flags |= configLockout;
+
+  return true;
 }
 
 bool DFR_Radar::setTriggerLevel( uint8_t triggerLevel )
@@ -191,7 +339,13 @@ bool DFR_Radar::setTriggerLevel( uint8_t triggerLevel )
   char _comSetGpioMode[16] = {0};
   sprintf( _comSetGpioMode, comSetGpioMode, triggerLevel );
 
-  return setConfig( _comSetGpioMode );
+  if( !setConfig( _comSetGpioMode ) )
+    return false;
+
+  config.triggerLevel = triggerLevel;
+  config.flags |= configTriggerLevel;
+
+  return true;
 }
 
 bool DFR_Radar::setDetectionRange( float rangeStart, float rangeEnd )
@@ -223,7 +377,14 @@ bool DFR_Radar::setDetectionRange( float rangeStart, float rangeEnd )
     sprintf( _comSetRange, comSetRange, rangeStart, rangeEnd );
   #endif
 
-  return setConfig( _comSetRange );
+  if( !setConfig( _comSetRange ) )
+    return false;
+
+  config.rangeStart = rangeStart;
+  config.rangeEnd = rangeEnd;
+  config.flags |= configRange;
+
+  return true;
 }
 
 bool DFR_Radar::setTriggerLatency( float confirmationDelay, float disappearanceDelay )
@@ -252,7 +413,14 @@ bool DFR_Radar::setTriggerLatency( float confirmationDelay, float disappearanceD
     sprintf( _comSetLatency, comSetLatency, confirmationDelay , disappearanceDelay );
   #endif
 
-  return setConfig( _comSetLatency );
+  if( !setConfig( _comSetLatency ) )
+    return false;
+
+  config.confirmationDelay = confirmationDelay;
+  config.disappearanceDelay = disappearanceDelay;
+  config.flags |= configTriggerLatency;
+
+  return true;
 }
 
 bool DFR_Radar::setOutputLatency( float triggerDelay, float resetDelay )
@@ -270,7 +438,14 @@ bool DFR_Radar::setOutputLatency( float triggerDelay, float resetDelay )
   char _comOutputLatency[29] = {0};
   sprintf( _comOutputLatency, comOutputLatency, (uint16_t)_triggerDelay , (uint16_t)_resetDelay );
 
-  return setConfig( _comOutputLatency );
+  if( !setConfig( _comOutputLatency ) )
+    return false;
+
+  config.triggerDelay = triggerDelay;
+  config.resetDelay = resetDelay;
+  config.flags |= configOutputLatency;
+
+  return true;
 }
 
 bool DFR_Radar::setSensitivity( uint8_t level )
@@ -281,7 +456,13 @@ bool DFR_Radar::setSensitivity( uint8_t level )
   char _comSetSensitivity[17] = {0};
   sprintf( _comSetSensitivity, comSetSensitivity, level );
 
-  return setConfig( _comSetSensitivity );
+  if( !setConfig( _comSetSensitivity ) )
+    return false;
+
+  config.sensitivity = level;
+  config.flags |= configSensitivity;
+
+  return true;
 }
 
 bool DFR_Radar::disableLED()
@@ -299,7 +480,31 @@ bool DFR_Radar::configureLED( bool disabled )
   char _comSetLedMode[15] = {0};
   sprintf( _comSetLedMode, comSetLedMode, disabled );
 
-  return setConfig( _comSetLedMode );
+  if( !setConfig( _comSetLedMode ) )
+    return false;
+
+  config.ledDisabled = disabled;
+  config.flags |= configLED;
+
+  return true;
+}
+
+bool DFR_Radar::setEcho( bool enabled )
+{
+  char _comSetEcho[10] = {0};
+  sprintf( _comSetEcho, comSetEcho, enabled );
+
+  if( !sendCommand( _comSetEcho, classControl ) )
+    return false;
+
+  echo = enabled;
+
+  return true;
+}
+
+bool DFR_Radar::isEchoEnabled()
+{
+  return echo;
 }
 
 bool DFR_Radar::factoryReset()
@@ -308,7 +513,12 @@ bool DFR_Radar::factoryReset()
   //   return false;
   stop();
 
-  bool success = sendCommand( comFactoryReset );
+  bool success = sendCommand( comFactoryReset, classReset );
+
+  // Nothing we've set is in effect any more
+  if( success )
+    config.flags = 0;
+
   delay( 2000 );
 
   return success;
@@ -324,6 +534,9 @@ bool DFR_Radar::configBegin()
 
   multiConfig = true;
 
+  // `configEnd()` will take care of anything that was waiting to be saved
+  savePending = false;
+
   return true;
 }
 
@@ -343,12 +556,223 @@ bool DFR_Radar::configEnd()
   return true;
 }
 
+bool DFR_Radar::setDeferredSave( uint16_t window )
+{
+  saveWindow = window;
+
+  if( !saveWindow )
+    return configFlush();
+
+  return true;
+}
+
+bool DFR_Radar::configFlush()
+{
+  if( !savePending )
+    return true;
+
+  // The sensor has to be stopped to save; it already is, unless an earlier
+  // attempt failed to save but got as far as re-starting it
+  stop();
+
+  bool success = saveConfig();
+  success &= start();
+
+  // If anything failed, keep the changes pending so that `update()` tries again
+  savePending = saveFailed = !success;
+  savePendingSince = millis();
+
+  return success;
+}
+
+bool DFR_Radar::isSavePending()
+{
+  return savePending;
+}
+
+void DFR_Radar::enableWatchdog( uint16_t timeout )
+{
+  heartbeatTimeout = timeout;
+  lastHeartbeat = millis();
+}
+
+void DFR_Radar::disableWatchdog()
+{
+  heartbeatTimeout = 0;
+}
+
+void DFR_Radar::onRecovery( RecoveryCallback callback )
+{
+  recoveryCallback = callback;
+}
+
+void DFR_Radar::update()
+{
+  // After a failed save, wait at least `saveRetryInterval` before trying again, so
+  // that a short (or no) window doesn't have every call blocking on the sensor
+  unsigned long flushAfter = saveFailed ? max( (unsigned long)saveWindow, (unsigned long)saveRetryInterval ) : saveWindow;
+
+  if( savePending && millis() - savePendingSince >= flushAfter )
+    configFlush();
+
+  // Leave the sensor alone if someone is in the middle of configuring it
+  if( !heartbeatTimeout || multiConfig )
+    return;
+
+  // If the sensor is sending periodic $JYBSS reports, each one is a heartbeat; these
+  // can be split across calls, so remember how much of the prefix we've matched
+  rxStart = rxLength = 0;
+
+  while( receive() )
+  {
+    for( size_t i = 0; i < rxLength; i++ )
+    {
+      char c = rxBuffer[i];
+
+      if( c == comReport[reportOffset] )
+        reportOffset++;
+      else
+        reportOffset = ( c == comReport[0] ) ? 1 : 0;
+
+      if( comReport[reportOffset] == '\0' )
+      {
+        lastHeartbeat = millis();
+        reportOffset = 0;
+      }
+    }
+
+    rxLength = 0;
+  }
+
+  if( millis() - lastHeartbeat < heartbeatTimeout )
+  {
+    recoveryBackoff = 0;
+    return;
+  }
+
+  // After a failed recovery, leave it longer and longer before trying again so
+  // that a sensor that stays dead doesn't keep `loop()` blocked
+  if( recoveryBackoff && millis() - lastRecovery < recoveryBackoff )
+    return;
+
+  // Nothing heard for a while, so ask; any response counts as a heartbeat
+  if( sendCommand( comGetOutput, classQuery ) )
+    return;
+
+  recover();
+}
+
+bool DFR_Radar::recover()
+{
+  unsigned long startTime = millis();
+  bool wasEcho = echo, recovered = false;
+
+  // Any session in progress is lost along with the sensor's state, but the
+  // settings it changed are in `config` and will be re-applied below
+  multiConfig = false;
+  savePending = false;
+
+  reboot();
+
+  // The sensor could come back either started or stopped, so don't trust our cached flag; once
+  // it acknowledges a `sensorStop` (or says it's stopped already) we know it's ready and stopped
+  stopped = false;
+
+  while( millis() - startTime < recoveryTimeout )
+  {
+    if( stop() )
+    {
+      recovered = true;
+      break;
+    }
+
+    delay( readyPollInterval );
+  }
+
+  if( recovered )
+  {
+    // Echoing comes back on after a reboot
+    if( !wasEcho && echo )
+      setEcho( false );
+
+    recovered = reapplyConfig();
+  }
+
+  lastRecovery = millis();
+
+  if( recovered )
+  {
+    lastHeartbeat = lastRecovery;
+    recoveryBackoff = 0;
+  }
+  else
+  {
+    recoveryBackoff = recoveryBackoff ? min( recoveryBackoff * 2, (unsigned long)maxRecoveryBackoff ) : minRecoveryBackoff;
+  }
+
+  if( recoveryCallback != NULL )
+    recoveryCallback( recovered, lastRecovery - startTime );
+
+  return recovered;
+}
+
+bool DFR_Radar::reapplyConfig()
+{
+  bool success = true;
+
+  if( !config.flags )
+    return start();
+
+  if( !configBegin() )
+    return false;
+
+  if( config.flags & configRange )
+    success &= setDetectionRange( config.rangeStart, config.rangeEnd );
+
+  if( config.flags & configSensitivity )
+    success &= setSensitivity( config.sensitivity );
+
+  if( config.flags & configTriggerLatency )
+    success &= setTriggerLatency( config.confirmationDelay, config.disappearanceDelay );
+
+  if( config.flags & configOutputLatency )
+    success &= setOutputLatency( config.triggerDelay, config.resetDelay );
+
+  if( config.flags & configLockout )
+    success &= setLockout( config.lockout );
+
+  if( config.flags & configTriggerLevel )
+    success &= setTriggerLevel( config.triggerLevel );
+
+  if( config.flags & configLED )
+    success &= configureLED( config.ledDisabled );
+
+  success &= configEnd();
+
+  return success;
+}
+
 bool DFR_Radar::setConfig( const char *command )
 {
   if( multiConfig )
   {
     return sendCommand( command );
   }
+  else if( saveWindow )
+  {
+    // A no-op after the first change, unless a failed flush re-started the sensor
+    stop();
+
+    // The window is measured from the first change so that a steady stream
+    // of changes can't keep the sensor stopped indefinitely
+    if( !savePending )
+    {
+      savePending = true;
+      savePendingSince = millis();
+    }
+
+    return sendCommand( command );
+  }
   else
   {
     // if( !stop() )
@@ -369,7 +793,7 @@ bool DFR_Radar::setConfig( const char *command )
 
 bool DFR_Radar::saveConfig()
 {
-  return sendCommand( comSaveCfg );
+  return sendCommand( comSaveCfg, classSave );
 }
 
 bool DFR_Radar::start()
@@ -402,7 +826,7 @@ bool DFR_Radar::stop()
 
 void DFR_Radar::reboot()
 {
-  sendCommand( comResetSystem );
+  sendCommand( comResetSystem, classReset );
 }
 
 size_t DFR_Radar::serialWrite( const char *command )
@@ -416,12 +840,8 @@ size_t DFR_Radar::serialWrite( const char *command )
   // Make a properly-terminated copy of the command
   snprintf( _command, commandLength, "%s\r\n", command );
 
-  // Make sure we have exactly enough time
-  sensorUART->setTimeout( comTimeout );
-
   // Clear the receive buffer
-  while( sensorUART->available() )
-    sensorUART->read();
+  discardInput();
 
   // Send the command...
   sensorUART->write( _command );
@@ -430,16 +850,16 @@ size_t DFR_Radar::serialWrite( const char *command )
   return commandLength;
 }
 
-bool DFR_Radar::sendCommand( const char *command )
+bool DFR_Radar::sendCommand( const char *command, CommandClass type )
 {
-  return sendCommand( command, NULL );
+  return sendCommand( command, NULL, type );
 }
 
-bool DFR_Radar::sendCommand( const char *command, const char *acceptableResponse )
+bool DFR_Radar::sendCommand( const char *command, const char *acceptableResponse, CommandClass type )
 {
-  bool errorAcceptable = false;
-  char lineBuffer[64] = {0};
-  unsigned long timeout = millis() + comTimeout;
+  bool errorAcceptable = false, echoed = false, retried = false;
+  char *lineBuffer;
+  unsigned long timeout = commandTimeout( type );
 
   static const size_t successLength = strlen( comResponseSuccess );
   static const size_t failLength = strlen( comResponseFail );
@@ -454,63 +874,177 @@ bool DFR_Radar::sendCommand( const char *command, const char *acceptableResponse
 
   // Send the command...
   serialWrite( command );
+  unsigned long startTime = millis(), firstSent = startTime;
 
-  // ...then wait for a response
-  while( millis() < timeout )
+  // ...then wait for a response, a whole line at a time
+  while( true )
   {
-    if( sensorUART->available() <= 0 )
-      continue;
+    while( ( lineBuffer = readLine( startTime, timeout ) ) != NULL )
+    {
+      size_t responseLength = strlen( lineBuffer );
+
+      // We got something shorter than anything we're expecting, so try again
+      if( responseLength < minLength )
+        continue;
+
+      // Check if that line is the command prompt
+      if( strncmp( comPrompt, lineBuffer, strlen( comPrompt ) ) == 0 )
+        continue;
+
+      // ...or if that line is an echo of the original command
+      if( strncmp( command, lineBuffer, commandLength ) == 0 )
+      {
+        echoed = true;
+        continue;
+      }
+
+      // ...or if that line contains an expected response
+      if( acceptableResponse != NULL && strncmp( acceptableResponse, lineBuffer, acceptableLength ) == 0 )
+      {
+        errorAcceptable = true;
+
+        // Even though we got what we want, we can't return yet; we need to go one more round
+        // so that we get the "Done" or "Error" that follows out of the serial buffer.
+        continue;
+      }
+
+      // ...or if that line says "Done" or "Error"
+      bool success = strncmp( comResponseSuccess, lineBuffer, successLength ) == 0;
+
+      if( success || strncmp( comResponseFail, lineBuffer, failLength ) == 0 )
+      {
+        // A complete response tells us whether the sensor is echoing; this keeps
+        // us in sync if echoing was toggled without our knowledge
+        echo = echoed;
+
+        // After a retry, there's no telling which of the two this is the response to, and
+        // the other one could still be on its way
+        if( !retried )
+          updateTimeout( type, millis() - startTime );
+        else
+          skipResponse( type, firstSent );
+
+        lastHeartbeat = millis();
+        return success || errorAcceptable;
+      }
+
+      // ...we got nothing we expected, so try again
+    }
 
-    // Ensure the buffer is empty
-    memset( &lineBuffer[0], 0, sizeof( lineBuffer ) );
+    // We've timed out
+    backoffTimeout( type );
 
-    // Read a whole line
-    size_t responseLength = sensorUART->readBytesUntil( '\n', lineBuffer, sizeof( lineBuffer ) );
+    if( errorAcceptable || retried )
+      return errorAcceptable;
 
-    // The sensor is supposed to terminate lines with <CRLF>, and we stopped at <LF>,
-    // so the last character in the line buffer should be a <CR>.  If so, swap it out
-    // for a null terminator
-    uint8_t lastCharacter = strlen( lineBuffer ) - 1;
-    if( lineBuffer[lastCharacter] == '\r' )
-      lineBuffer[lastCharacter] = '\0';
+    // Give it one more chance, in case our timeout was just a bit too keen
+    if( !( timeout = retryTimeout( type, firstSent ) ) )
+      return false;
 
-    // Update the length and ensure the line we've received is properly terminated
-    responseLength = strlen( lineBuffer );
-    lineBuffer[responseLength] = '\0';
+    retried = true;
+    echoed = false;
 
-    // We got something shorter than anything we're expecting, so try again
-    if( responseLength < minLength )
-      continue;
+    serialWrite( command );
+    startTime = millis();
+  }
+}
 
-    // Check if that line is the command prompt
-    if( strncmp( comPrompt, lineBuffer, strlen( comPrompt ) ) == 0 )
-      continue;
+void DFR_Radar::skipResponse( CommandClass type, unsigned long firstSent )
+{
+  unsigned long startTime = millis();
+  unsigned long timeout = min( (unsigned long)commandTimeout( type ), (unsigned long)retryTimeout( type, firstSent ) );
+  char *lineBuffer;
 
-    // ...or if that line is an echo of the original command
-    if( strncmp( command, lineBuffer, commandLength ) == 0 )
-      continue;
+  while( ( lineBuffer = readLine( startTime, timeout ) ) != NULL )
+  {
+    if( strncmp( comResponseSuccess, lineBuffer, strlen( comResponseSuccess ) ) == 0 ||
+        strncmp( comResponseFail, lineBuffer, strlen( comResponseFail ) ) == 0 )
+      return;
+  }
+}
 
-    // ...or if that line contains an expected response
-    if( acceptableResponse != NULL && strncmp( acceptableResponse, lineBuffer, acceptableLength ) == 0 )
-    {
-      errorAcceptable = true;
+void DFR_Radar::resetTimeouts()
+{
+  for( uint8_t i = 0; i < classCount; i++ )
+  {
+    roundTrip[i].srtt = 0;
+    roundTrip[i].rttvar = 0;
+    roundTrip[i].timeout = maxTimeout[i];
+  }
+}
 
-      // Even though we got what we want, we can't return yet; we need to go one more round
-      // so that we get the "Done" or "Error" that follows out of the serial buffer.
-      continue;
-    }
+uint16_t DFR_Radar::transferTime( CommandClass type )
+{
+  // Each byte is 10 bits on the wire (start + 8 data + stop); round up
+  return ( responseLength[type] * 10000UL + baudRate - 1 ) / baudRate;
+}
+
+uint16_t DFR_Radar::shortestTimeout( CommandClass type )
+{
+  // Always allow for the response to cross the wire (twice, in case the
+  // sensor was in the middle of sending something else) plus a little slack
+  return 2 * transferTime( type ) + minTimeoutMargin;
+}
 
-    // ...or if that line says "Done"
-    if( strncmp( comResponseSuccess, lineBuffer, successLength ) == 0 )
-      return true;
+uint16_t DFR_Radar::commandTimeout( CommandClass type )
+{
+  const RoundTrip &rt = roundTrip[type];
 
-    // ...or if that line says "Error"
-    if( strncmp( comResponseFail, lineBuffer, failLength ) == 0 )
-      return errorAcceptable;
+  // However steady the sensor has been, allow twice the usual round trip, so
+  // that ordinary jitter doesn't cost a retry
+  uint16_t shortest = max( shortestTimeout( type ), (uint16_t)( rt.srtt >> 2 ) );
+
+  return min( max( rt.timeout, shortest ), maxTimeout[type] );
+}
+
+uint16_t DFR_Radar::retryTimeout( CommandClass type, unsigned long firstSent )
+{
+  // Resetting takes the sensor offline for a while, so sending it again would only reset it twice
+  if( type == classReset )
+    return 0;
 
-    // ...we got nothing we expected, so try again
+  // The retry only gets what's left of the class's limit, so the two attempts together
+  // never take longer than a single one with the fixed timeout would have
+  unsigned long elapsed = millis() - firstSent;
+
+  if( elapsed + shortestTimeout( type ) > maxTimeout[type] )
+    return 0;
+
+  return maxTimeout[type] - elapsed;
+}
+
+void DFR_Radar::updateTimeout( CommandClass type, unsigned long rtt )
+{
+  RoundTrip &rt = roundTrip[type];
+
+  if( rtt > maxTimeout[type] )
+    rtt = maxTimeout[type];
+
+  if( rt.srtt == 0 )
+  {
+    // First measurement: SRTT = R, RTTVAR = R / 2
+    rt.srtt = rtt << 3;
+    rt.rttvar = rtt << 1;
   }
+  else
+  {
+    // SRTT += (R - SRTT) / 8, RTTVAR += (|R - SRTT| - RTTVAR) / 4
+    int32_t error = (int32_t)rtt - ( rt.srtt >> 3 );
+    rt.srtt += error;
+
+    if( error < 0 )
+      error = -error;
+
+    rt.rttvar += error - ( rt.rttvar >> 2 );
+  }
+
+  // RTO = SRTT + 4 * RTTVAR
+  uint32_t timeout = ( rt.srtt >> 3 ) + rt.rttvar;
+  rt.timeout = min( timeout, (uint32_t)maxTimeout[type] );
+}
 
-  // We've timed out
-  return errorAcceptable;
+void DFR_Radar::backoffTimeout( CommandClass type )
+{
+  uint32_t timeout = 2UL * commandTimeout( type );
+  roundTrip[type].timeout = min( timeout, (uint32_t)maxTimeout[type] );
 }
@@ -22,6 +22,14 @@ class DFR_Radar
 {
   public:
 
+    /**
+     * @brief Signature for a function to be called after the sensor has been recovered
+     *
+     * @param recovered    true if the sensor is responding again, false if recovery failed
+     * @param recoveryTime Time in milliseconds that recovery took
+     */
+    typedef void (*RecoveryCallback)( bool recovered, unsigned long recoveryTime );
+
     /**
       * @brief Constructor
       * @param Stream  Software serial port interface
@@ -29,9 +37,13 @@ class DFR_Radar
     DFR_Radar( Stream *s );
 
     /**
-     * @brief Not currently implemented
+     * @brief Prepare the sensor for use by this library
      *
-     * @return true
+     * @note Currently this only disables command echoing, which trims roughly a third
+     *       of the bytes the sensor sends back for every command.
+     *
+     * @return true if the sensor acknowledged the change;
+     *         false if the sensor did not respond
      */
     bool begin( void );
 
@@ -42,6 +54,17 @@ class DFR_Radar
      */
     void setStream( Stream *s );
 
+    /**
+     * @brief Tell the library what baud rate the sensor's serial port is running at
+     *
+     * @note `Stream` doesn't expose this, but it is needed to work out how long a response
+     *       should take to arrive, which sets the floor for each command's timeout.  Call this
+     *       if you've changed the sensor away from its factory default of 115200.
+     *
+     * @param baud  The baud rate passed to `begin()` on the serial port; 0 restores the default
+     */
+    void setBaudRate( uint32_t baud );
+
     /**
      * @brief Check if the sensor is ready to accept commands
      *
@@ -174,6 +197,27 @@ class DFR_Radar
      */
     bool configureLED( bool disabled );
 
+    /**
+     * @brief Set whether the sensor echoes each command back before responding
+     *
+     * @note This is not saved to flash, so the sensor reverts to the factory default
+     *       (echo on) after a reboot or power cycle.  The library keeps track of what
+     *       it actually sees on the wire, so responses are still parsed correctly if
+     *       echoing is switched back on some other way (e.g. a DirectSerial session).
+     *
+     * @param enabled true to echo commands (factory default), false to disable
+     *
+     * @return true if command was successful
+     */
+    bool setEcho( bool enabled );
+
+    /**
+     * @brief Check whether the sensor is believed to be echoing commands
+     *
+     * @return true if command echoing is enabled (or hasn't been negotiated yet)
+     */
+    bool isEchoEnabled( void );
+
     /**
      * @brief Allows setting multiple configuration options without
      *        stopping/saving/re-starting with each one.  Make sure
@@ -193,6 +237,88 @@ class DFR_Radar
      */
     bool configEnd( void );
 
+    /**
+     * @brief Merge bursts of configuration changes into a single save and re-start.
+     *
+     * @details When enabled, the first configuration change stops the sensor and the changes
+     *          that follow are sent straight away, but the configuration isn't saved and the
+     *          sensor isn't re-started until `window` milliseconds after that first change.
+     *          Call `update()` from your `loop()` to have this happen automatically, or call
+     *          `configFlush()` to do it right away.
+     *
+     * @note Presence detection is paused while changes are pending.
+     *
+     * @param window  Time in milliseconds to wait for more changes; 0 disables (factory default)
+     *
+     * @return false if disabling and saving or re-starting pending changes failed, true otherwise
+     */
+    bool setDeferredSave( uint16_t window );
+
+    /**
+     * @brief Save any configuration changes held back by `setDeferredSave()` and re-start the sensor
+     *
+     * @note If saving or re-starting fails, the changes stay pending and `update()` tries again
+     *       after another window (but no sooner than a second later)
+     *
+     * @return true if there was nothing pending, or if saving and re-starting succeeded;
+     *         false if saving or re-starting failed
+     */
+    bool configFlush( void );
+
+    /**
+     * @brief Check whether there are configuration changes waiting to be saved
+     *
+     * @return true if changes held back by `setDeferredSave()` haven't been saved yet (or saving failed)
+     */
+    bool isSavePending( void );
+
+    /**
+     * @brief Watch for the sensor going quiet and automatically recover it if it does.
+     *
+     * @details Successful commands, `checkPresence()` and periodic $JYBSS reports all count
+     *          as a heartbeat.  If none have been seen for `heartbeatTimeout` milliseconds,
+     *          `update()` queries the sensor, and if that fails too, calls `recover()`.  If
+     *          recovery fails, the wait before the next attempt doubles each time (from 1s
+     *          up to 60s) until the sensor responds again.
+     *
+     * @note Periodic reports are consumed by `update()` while the watchdog is enabled.
+     *
+     * @param heartbeatTimeout  Time in milliseconds without a heartbeat before checking on the sensor
+     */
+    void enableWatchdog( uint16_t heartbeatTimeout );
+
+    /**
+     * @brief Stop watching for the sensor going quiet (factory default)
+     */
+    void disableWatchdog( void );
+
+    /**
+     * @brief Set a function to be called whenever the sensor has been recovered
+     *
+     * @param callback  The function to call, or NULL for none
+     */
+    void onRecovery( RecoveryCallback callback );
+
+    /**
+     * @brief Reboot the sensor and bring it back to a known state: wait until it responds,
+     *        re-sync whether it's stopped, then re-apply the configuration set through
+     *        this library and re-start it.
+     *
+     * @note Called by `update()` when the watchdog finds the sensor unresponsive
+     *
+     * @return true if the sensor is responding and running again;
+     *         false if the sensor didn't respond in time or couldn't be re-configured
+     */
+    bool recover( void );
+
+    /**
+     * @brief Housekeeping; call this regularly from your `loop()`
+     *
+     * @note This saves deferred configuration changes once their window has elapsed, and
+     *       if the watchdog is enabled, checks that the sensor is still alive
+     */
+    void update( void );
+
     /**
      * @brief Restore the sensor configuration to factory default settings.
      *
@@ -204,13 +330,157 @@ class DFR_Radar
   private:
 
     /**
-     * @brief Read a line (or more) from the UART port
+     * @brief Groups of commands that take a similar amount of time to complete, each of which
+     *        gets its own timeout
+     */
+    enum CommandClass : uint8_t
+    {
+      classQuery,   // getOutput
+      classControl, // sensorStart, sensorStop, setEcho
+      classConfig,  // the various set* commands
+      classSave,    // saveConfig (writes to flash)
+      classReset,   // resetCfg, resetSystem
+      classCount
+    };
+
+    /**
+     * @brief Smoothed round-trip time for a command class, in the style of TCP's RTO
+     *        estimator (RFC 6298): `srtt` is scaled by 8 and `rttvar` by 4, so the
+     *        timeout is simply `srtt / 8 + rttvar`
+     */
+    struct RoundTrip
+    {
+      uint16_t srtt;
+      uint16_t rttvar;
+      uint16_t timeout;
+    };
+
+    /**
+     * @brief Flags for which settings in `Config` have been set through this library
+     */
+    enum ConfigFlag : uint8_t
+    {
+      configRange          = 0x01,
+      configSensitivity    = 0x02,
+      configTriggerLatency = 0x04,
+      configOutputLatency  = 0x08,
+      configLockout        = 0x10,
+      configTriggerLevel   = 0x20,
+      configLED            = 0x40
+    };
+
+    /**
+     * @brief The last value of each setting that the sensor accepted, so that they can be
+     *        re-applied after recovery; a rejected value is never recorded, or every recovery
+     *        would try it again and fail
+     */
+    struct Config
+    {
+      uint8_t flags;
+      float rangeStart, rangeEnd;
+      uint8_t sensitivity;
+      float confirmationDelay, disappearanceDelay;
+      float triggerDelay, resetDelay;
+      float lockout;
+      uint8_t triggerLevel;
+      bool ledDisabled;
+    };
+
+    /**
+     * @brief Send the configuration recorded in `config` to the sensor, then save and re-start
+     *
+     * @return true if every setting was accepted, and saving and re-starting succeeded
+     */
+    bool reapplyConfig( void );
+
+    /**
+     * @brief Move everything waiting in the UART's receive buffer into `rxBuffer`, as much
+     *        as fits, with a single `available()` call
+     *
+     * @return number of bytes received
+     */
+    size_t receive( void );
+
+    /**
+     * @brief Wait for the next complete line from the UART port
+     *
+     * @note The line is terminated in place within `rxBuffer` (no copy is made), so it's
+     *       only valid until the next call to `readLine()`, `receive()` or `discardInput()`
+     *
+     * @param startTime When the wait started, from `millis()`
+     * @param timeout   Time in milliseconds from `startTime` to give up
+     *
+     * @return the line, without its line ending;
+     *         NULL if no complete line arrived in time
+     */
+    char *readLine( unsigned long startTime, unsigned long timeout );
+
+    /**
+     * @brief Throw away everything that has been received so far
+     */
+    void discardInput( void );
+
+    /**
+     * @brief Time in milliseconds to wait for a response to a command
+     *
+     * @param type The class of command being sent
+     */
+    uint16_t commandTimeout( CommandClass type );
+
+    /**
+     * @brief Shortest time in milliseconds worth waiting for a response to a command
+     *
+     * @param type The class of command being sent
+     */
+    uint16_t shortestTimeout( CommandClass type );
+
+    /**
+     * @brief Time in milliseconds to wait for a response to a command sent a second time,
+     *        after the first one timed out
+     *
+     * @param type      The class of command being sent
+     * @param firstSent When the command was first sent, from `millis()`
+     *
+     * @return 0 if it isn't worth sending again
+     */
+    uint16_t retryTimeout( CommandClass type, unsigned long firstSent );
+
+    /**
+     * @brief After a command was answered on its second attempt, wait (as long as the class's
+     *        limit allows) for the other response and throw it away, so that it isn't mistaken
+     *        for the response to the next command
      *
-     * @param buffer Store the read data
+     * @param type      The class of command that was sent
+     * @param firstSent When the command was first sent, from `millis()`
+     */
+    void skipResponse( CommandClass type, unsigned long firstSent );
+
+    /**
+     * @brief Time in milliseconds that a response to a command takes just to cross the wire
+     *
+     * @param type The class of command being sent
+     */
+    uint16_t transferTime( CommandClass type );
+
+    /**
+     * @brief Feed a measured round-trip time into the estimator for a command class
      *
-     * @return length of characters captured
+     * @param type The class of command that was sent
+     * @param rtt  Time in milliseconds from sending the command to receiving the full response
      */
-    size_t readLines( char *buffer, size_t lineCount = 1 );
+    void updateTimeout( CommandClass type, unsigned long rtt );
+
+    /**
+     * @brief Double the timeout for a command class after it has timed out (up to its limit)
+     *
+     * @param type The class of command that timed out
+     */
+    void backoffTimeout( CommandClass type );
+
+    /**
+     * @brief Reset the timeouts for every command class to their initial values
+     */
+    void resetTimeouts( void );
 
     /**
      * @brief Executes a command string after first stopping the sensor, then afterwards
@@ -219,6 +489,8 @@ class DFR_Radar
      * @details If multi-config mode is enabled (`configBegin()` was called earlier),
      *          this this method only executes the command string, and `configEnd()`
      *          must be called to save the configuration and re-start the sensor.
+     *          Likewise if deferred saving is enabled, saving and re-starting are left
+     *          for `update()` or `configFlush()`.
      *
      * @param command A command string generated by one of the configuration methods
      *
@@ -247,11 +519,12 @@ class DFR_Radar
      * @brief Writes a command string to the sensor UART port and waits for response
      *
      * @param command A command string generated by one of the other config/command methods
+     * @param type    The class of command, which determines how long to wait for a response
      *
      * @return true if response was "Done";
      *         false if "Error" or timeout
      */
-    bool sendCommand( const char *command );
+    bool sendCommand( const char *command, CommandClass type = classConfig );
 
     /**
      * @brief Writes a command string to the sensor UART port and compares the response to one provided
@@ -262,11 +535,12 @@ class DFR_Radar
      *
      * @param command        A command string generated by one of the other config/command methods
      * @param acceptResponse The word or phrase to look for that if found will return `true`
+     * @param type           The class of command, which determines how long to wait for a response
      *
      * @return true if response was "Done" or matched `acceptResponse`;
      *         false if timeout or "Error" (and response didn't already match `acceptResponse`)
      */
-    bool sendCommand( const char *command, const char *acceptResponse );
+    bool sendCommand( const char *command, const char *acceptResponse, CommandClass type = classControl );
 
     /**
      * @brief The serial port (hardware or software) to use for communicating with the sensor
@@ -277,13 +551,42 @@ class DFR_Radar
     // bool isConfigured;
     bool stopped;
     bool multiConfig;
+    bool echo;
+
+    bool savePending;
+    bool saveFailed;
+    uint16_t saveWindow;
+    unsigned long savePendingSince;
+
+    Config config;
+
+    uint16_t heartbeatTimeout;
+    unsigned long lastHeartbeat;
+    uint8_t reportOffset;
+    RecoveryCallback recoveryCallback;
+    unsigned long recoveryBackoff;
+    unsigned long lastRecovery;
+
+    uint32_t baudRate;
+    RoundTrip roundTrip[classCount];
+
+    static const uint32_t defaultBaudRate           = 115200;
+    static const uint16_t minTimeoutMargin          =   10;
 
     static const uint16_t readPacketTimeout         =  100;
     static const size_t packetLength                =   64;
 
     static const unsigned long startupDelay         = 2000;
+    static const unsigned long recoveryTimeout      = 10000;
+    static const unsigned long readyPollInterval    =  100;
+    static const unsigned long minRecoveryBackoff   =  1000;
+    static const unsigned long maxRecoveryBackoff   = 60000;
 
     static const unsigned long comTimeout           = 1000;
+    static const unsigned long saveRetryInterval    = 1000;
+
+    static const uint8_t responseLength[classCount];
+    static const uint16_t maxTimeout[classCount];
     static constexpr const char *comStop            = "sensorStop";
     static constexpr const char *comStart           = "sensorStart";
     static constexpr const char *comResetSystem     = "resetSystem 0";
@@ -293,7 +596,7 @@ class DFR_Radar
     static constexpr const char *comGetOutput       = "getOutput 1";
     static constexpr const char *comSetLedMode      = "setLedMode 1 %u";
     // static constexpr const char *comSetUartOutput   = "setUartOutput 1 1 0 1501";
-    static constexpr const char *comSetEcho         = "setEcho 0";
+    static constexpr const char *comSetEcho         = "setEcho %u";
     static constexpr const char *comResponseSuccess = "Done";
     static constexpr const char *comResponseFail    = "Error";
     static constexpr const char *comFailStopped     = "sensor stopped already";
@@ -301,6 +604,7 @@ class DFR_Radar
     static constexpr const char *comSaveCfg         = "saveConfig";
     static constexpr const char *comFactoryReset    = "resetCfg";
     static constexpr const char *comPrompt          = "leapMMW:/>";
+    static constexpr const char *comReport          = "$JYBSS";
 
     #ifdef __AVR__
       #ifdef _STDLIB_H_
@@ -322,6 +626,14 @@ class DFR_Radar
       static constexpr const char *comSetLatency    = "setLatency %.3f %.3f";
       static constexpr const char *comSetInhibit    = "setInhibit %.3f";
     #endif
+
+    /**
+     * @brief Data received from the sensor that hasn't been parsed yet; `rxStart` is
+     *        where the next line begins and `rxLength` is how much is in use
+     */
+    char rxBuffer[packetLength];
+    size_t rxStart;
+    size_t rxLength;
 };
 
 #endif
@@ -0,0 +1,365 @@
+/**
+  * @file       DFR_RadarEventLog.h
+  * @brief      A compact, fixed-size log of presence transitions, and a frame format for sending them over low-bandwidth links
+  * @copyright  Copyright (c) 2026 DFR_Radar contributors
+  * @license    The MIT License (MIT)
+  * @url        https://github.com/MaffooClock/DFRobot_Radar
+  *
+  * @details    The log only records the moments presence changes, so a sensor that sits idle all
+  *             day costs nothing, and the state between records never has to be stored because it
+  *             simply alternates.  `serialize()` packs the transitions within a time window into a
+  *             frame like this:
+  *
+  *               byte 0    bit 0   presence at the start of the window
+  *                         bit 1   older transitions were dropped, so the start of the window may be incomplete
+  *                         bit 2   the frame ran out of room before the end of the window
+  *                         bit 3-5 resolution (see `DFR_RadarEventFrame::Resolution`)
+  *                         bit 6-7 format version
+  *               byte 1-   one unsigned LEB128 varint per transition: the time since the previous
+  *                         transition (or the start of the window, for the first one), in units
+  *                         of the resolution
+  *
+  *             This header doesn't depend on Arduino, so the same `DFR_RadarEventFrame` decoder can be
+  *             built into whatever receives the frames.
+  */
+
+
+#ifndef __DFR_RadarEventLog_H__
+#define __DFR_RadarEventLog_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+template<size_t Capacity>
+class DFR_RadarEventLog;
+
+
+/**
+ * @brief Reads back a frame created by `DFR_RadarEventLog::serialize()`
+ *
+ * @details Usage:
+ *
+ *            DFR_RadarEventFrame frame( data, length );
+ *            uint32_t offset;
+ *            bool presence;
+ *
+ *            while( frame.next( offset, presence ) )
+ *              // presence changed to `presence`, `offset` milliseconds after the start of the window
+ */
+class DFR_RadarEventFrame
+{
+  public:
+
+    /**
+     * @brief Units for the time deltas in a frame; coarser units mean smaller frames
+     */
+    enum Resolution : uint8_t
+    {
+      resolution1ms,
+      resolution10ms,
+      resolution100ms,
+      resolution1s,
+      resolution10s,
+      resolution1min
+    };
+
+    /**
+     * @brief Convert a resolution to milliseconds
+     *
+     * @return the number of milliseconds in one unit, or 0 if the resolution is invalid
+     */
+    static uint32_t units( uint8_t resolution )
+    {
+      static const uint32_t milliseconds[] = { 1, 10, 100, 1000, 10000, 60000 };
+
+      return resolution < sizeof( milliseconds ) / sizeof( milliseconds[0] ) ? milliseconds[resolution] : 0;
+    }
+
+    DFR_RadarEventFrame( const uint8_t *frame, size_t length ) :
+      data( frame ), size( length ), offset( 1 ), elapsed( 0 )
+    {
+      presence = isValid() && initialPresence();
+    }
+
+    /**
+     * @brief Check that the frame has a header of a version and resolution we understand
+     */
+    bool isValid( void ) const
+    {
+      return ( header() >> 6 ) == version && resolution() != 0;
+    }
+
+    /**
+     * @brief Presence at the start of the window
+     */
+    bool initialPresence( void ) const
+    {
+      return header() & presenceFlag;
+    }
+
+    /**
+     * @brief Whether transitions from before the start of the window had been dropped from the log
+     */
+    bool isHeadTruncated( void ) const
+    {
+      return header() & headTruncatedFlag;
+    }
+
+    /**
+     * @brief Whether the frame was too small to hold every transition in the window
+     */
+    bool isTailTruncated( void ) const
+    {
+      return header() & tailTruncatedFlag;
+    }
+
+    /**
+     * @brief Milliseconds per unit of time in the frame
+     */
+    uint32_t resolution( void ) const
+    {
+      return units( ( header() >> 3 ) & 0x07 );
+    }
+
+    /**
+     * @brief Read the next transition
+     *
+     * @param time   Time of the transition in milliseconds since the start of the window
+     * @param state  Presence state after the transition
+     *
+     * @return false when there are no more transitions or the frame is malformed
+     */
+    bool next( uint32_t &time, bool &state )
+    {
+      if( !isValid() )
+        return false;
+
+      uint32_t delta = 0;
+      uint8_t shift = 0;
+
+      while( true )
+      {
+        if( offset >= size || shift > 28 )
+          return false;
+
+        uint8_t digit = data[offset++];
+        delta |= (uint32_t)( digit & 0x7F ) << shift;
+        shift += 7;
+
+        if( !( digit & 0x80 ) )
+          break;
+      }
+
+      elapsed += delta;
+      presence = !presence;
+
+      time = elapsed * resolution();
+      state = presence;
+
+      return true;
+    }
+
+  private:
+
+    template<size_t Capacity>
+    friend class DFR_RadarEventLog;
+
+    static constexpr uint8_t version = 1;
+
+    static constexpr uint8_t presenceFlag      = 0x01;
+    static constexpr uint8_t headTruncatedFlag = 0x02;
+    static constexpr uint8_t tailTruncatedFlag = 0x04;
+
+    /**
+     * @brief The header byte, or 0 (which is never valid) if the frame is empty
+     */
+    uint8_t header( void ) const
+    {
+      return size > 0 ? data[0] : 0;
+    }
+
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    uint32_t elapsed;
+    bool presence;
+};
+
+/**
+ * @brief Ring buffer of presence transitions.  Once full, the oldest transitions are dropped.
+ *
+ * @tparam Capacity  Number of transitions to keep; each one takes 4 bytes
+ */
+template<size_t Capacity>
+class DFR_RadarEventLog
+{
+  public:
+
+    DFR_RadarEventLog()
+    {
+      clear();
+    }
+
+    /**
+     * @brief Forget every transition; presence is assumed to be false until told otherwise
+     */
+    void clear( void )
+    {
+      head = 0;
+      length = 0;
+      baseState = false;
+      dropped = false;
+      droppedTime = 0;
+    }
+
+    /**
+     * @brief Record the current presence state; only changes are actually stored, so
+     *        it's fine to call this with every `checkPresence()` or IO2 reading
+     *
+     * @param presence  Whether presence is currently detected
+     * @param now       The current time in milliseconds, e.g. `millis()`
+     */
+    void record( bool presence, uint32_t now )
+    {
+      if( presence == state() )
+        return;
+
+      if( length == Capacity )
+      {
+        // The oldest transition becomes the starting state
+        droppedTime = times[head];
+        dropped = true;
+        baseState = !baseState;
+        head = ( head + 1 ) % Capacity;
+        length--;
+      }
+
+      times[( head + length ) % Capacity] = now;
+      length++;
+    }
+
+    /**
+     * @brief The most recently recorded presence state
+     */
+    bool state( void ) const
+    {
+      // States alternate, so an odd number of transitions means the opposite of where we started
+      return baseState ^ ( length & 1 );
+    }
+
+    /**
+     * @brief Number of transitions currently held
+     */
+    size_t count( void ) const
+    {
+      return length;
+    }
+
+    /**
+     * @brief Pack the transitions that occurred within a time window into a frame
+     *
+     * @param from        Start of the window in milliseconds (inclusive)
+     * @param to          End of the window in milliseconds (exclusive)
+     * @param frame       Where to write the frame
+     * @param size        Size of `frame` in bytes; transitions that don't fit are left out
+     *                    and the frame is flagged as such
+     * @param resolution  Units for the time deltas
+     *
+     * @return length of the frame in bytes; 0 if `size` or `resolution` is invalid
+     */
+    size_t serialize( uint32_t from, uint32_t to, uint8_t *frame, size_t size, uint8_t resolution = DFR_RadarEventFrame::resolution1s ) const
+    {
+      uint32_t units = DFR_RadarEventFrame::units( resolution );
+      uint32_t window = to - from;
+
+      if( !size || !units )
+        return 0;
+
+      // Skip past anything from before the window
+      size_t i = 0;
+      while( i < length && (int32_t)( timeAt( i ) - from ) < 0 )
+        i++;
+
+      // Presence at the start of the window is the opposite of the first transition in it; that
+      // still holds after dropping transitions, unless one of those was inside the window itself
+      bool presence = baseState ^ ( i & 1 );
+      bool headTruncated = dropped && (int32_t)( droppedTime - from ) >= 0;
+
+      uint8_t header = ( DFR_RadarEventFrame::version << 6 ) | ( resolution << 3 );
+
+      if( presence )
+        header |= DFR_RadarEventFrame::presenceFlag;
+
+      if( headTruncated )
+        header |= DFR_RadarEventFrame::headTruncatedFlag;
+
+      size_t offset = 1;
+      uint32_t previous = 0;
+
+      for( ; i < length; i++ )
+      {
+        uint32_t elapsed = timeAt( i ) - from;
+
+        if( elapsed >= window )
+          break;
+
+        // Quantise the absolute offset rather than each delta, so rounding doesn't accumulate
+        elapsed /= units;
+
+        uint8_t encoded[5];
+        size_t encodedLength = encodeVarint( elapsed - previous, encoded );
+
+        if( offset + encodedLength > size )
+        {
+          header |= DFR_RadarEventFrame::tailTruncatedFlag;
+          break;
+        }
+
+        for( size_t j = 0; j < encodedLength; j++ )
+          frame[offset++] = encoded[j];
+
+        previous = elapsed;
+      }
+
+      frame[0] = header;
+
+      return offset;
+    }
+
+  private:
+
+    uint32_t timeAt( size_t index ) const
+    {
+      return times[( head + index ) % Capacity];
+    }
+
+    static size_t encodeVarint( uint32_t value, uint8_t *buffer )
+    {
+      size_t length = 0;
+
+      do
+      {
+        uint8_t digit = value & 0x7F;
+        value >>= 7;
+
+        if( value )
+          digit |= 0x80;
+
+        buffer[length++] = digit;
+      }
+      while( value );
+
+      return length;
+    }
+
+    uint32_t times[Capacity];
+    size_t head;
+    size_t length;
+
+    bool baseState;
+    bool dropped;
+    uint32_t droppedTime;
+};
+
+#endif
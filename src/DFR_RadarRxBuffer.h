@@ -0,0 +1,338 @@
+/**
+  * @file       DFR_RadarRxBuffer.h
+  * @brief      A larger receive buffer to sit between a UART and DFR_Radar, so that sensor data isn't lost during blocking work
+  * @copyright  Copyright (c) 2026 DFR_Radar contributors
+  * @license    The MIT License (MIT)
+  * @url        https://github.com/MaffooClock/DFRobot_Radar
+  *
+  * @details    On AVR the core's HardwareSerial only buffers 64 bytes, which the sensor fills in about
+  *             5ms at 115200 baud, so anything longer (like a `delay()`) loses responses and $JYBSS
+  *             reports.  This is a lock-free single-producer/single-consumer ring that behaves like any
+  *             other `Stream`, so it can be handed to `DFR_Radar` in place of the UART:
+  *
+  *               DFR_RadarRxBuffer<256> sensorRx( &Serial1 );
+  *               DFR_Radar sensor( &sensorRx );
+  *
+  *             It can be filled in one of two ways (pick one, not both):
+  *
+  *              - Polling (default): `poll()` moves whatever the UART has received into the ring.  It's
+  *                called automatically whenever the ring runs dry, and to keep the UART drained during
+  *                `delay()`, call it from `yield()` too -- the AVR, SAMD and Teensy cores call `yield()`
+  *                continuously while in `delay()`.  Other blocking work isn't covered.
+  *
+  *              - Interrupt: construct with `fedByInterrupt = true`, then either call `poll()` from a
+  *                periodic timer interrupt (every 1ms comfortably keeps up with 115200 baud, see the
+  *                LargeRxBuffer example), or call `receive()` with each byte from your own UART receive
+  *                interrupt.  The ring is then only ever filled from that interrupt, so it keeps up
+  *                whatever the sketch is doing.
+  *
+  *             `overruns()` counts bytes dropped because the ring was full.  Bytes the core drops because
+  *             its own buffer filled up never reach us, so they can't be counted; instead, if given the
+  *             size of that buffer, `poll()` counts how many times it found it full (`uartFullCount()`).
+  *
+  *             On ESP32, the IDF UART driver already buffers in its own interrupt handler, so it's
+  *             simpler to call `Serial1.setRxBufferSize()` before `Serial1.begin()` instead.
+  */
+
+
+#ifndef __DFR_RadarRxBuffer_H__
+#define __DFR_RadarRxBuffer_H__
+
+#include <Arduino.h>
+
+#ifdef __AVR__
+  #include <util/atomic.h>
+#endif
+
+
+/**
+ * @brief Picks the smallest unsigned type that can index a ring: a single-byte index is
+ *        a single (atomic) load on AVR, so rings of up to 256 bytes don't need interrupt guards
+ */
+template<bool Small>
+struct DFR_RadarRxBufferIndex
+{
+  typedef uint16_t type;
+};
+
+template<>
+struct DFR_RadarRxBufferIndex<true>
+{
+  typedef uint8_t type;
+};
+
+
+/**
+ * @brief Receive ring buffer for the sensor's UART
+ *
+ * @tparam Size  Size of the ring in bytes; must be a power of two, and one byte is kept free to
+ *               tell a full ring from an empty one
+ */
+template<size_t Size>
+class DFR_RadarRxBuffer : public Stream
+{
+  static_assert( Size >= 2 && ( Size & ( Size - 1 ) ) == 0, "DFR_RadarRxBuffer size must be a power of two" );
+  static_assert( Size <= 65536, "DFR_RadarRxBuffer size must be 65536 or less" );
+
+  public:
+
+    /**
+     * @brief Constructor
+     *
+     * @param uart            The serial port connected to the sensor; always used for sending
+     * @param fedByInterrupt  true if the ring will be filled from an interrupt (by `poll()` or
+     *                        `receive()`), false to poll `uart` whenever the ring runs dry (default)
+     * @param uartBufferSize  Size of `uart`'s own receive buffer (e.g. `SERIAL_RX_BUFFER_SIZE` for
+     *                        HardwareSerial on AVR), so `poll()` can tell when it fills up; 0 (default)
+     *                        to not check
+     */
+    DFR_RadarRxBuffer( Stream *uart, bool fedByInterrupt = false, size_t uartBufferSize = 0 ) :
+      sensorUART( uart ), polled( !fedByInterrupt ), uartLimit( uartBufferSize ? uartBufferSize - 1 : 0 ),
+      head( 0 ), tail( 0 ), overrunCount( 0 ), uartFullTimes( 0 )
+    {}
+
+    /**
+     * @brief Add a received byte to the ring.  Safe to call from an interrupt.
+     *
+     * @note If the ring is full, the byte is dropped and counted as an overrun
+     *
+     * @param c The byte received
+     */
+    void receive( uint8_t c )
+    {
+      Index next = ( head + 1 ) & mask;
+
+      if( next == loadTail() )
+      {
+        overrunCount++;
+        return;
+      }
+
+      buffer[head] = c;
+      barrier();
+      head = next;
+    }
+
+    /**
+     * @brief Move everything the UART has received into the ring (as much as fits)
+     *
+     * @note When fed by interrupt, only call this from that interrupt
+     *
+     * @return number of bytes moved
+     */
+    size_t poll( void )
+    {
+      int available = sensorUART->available();
+
+      if( available <= 0 )
+        return 0;
+
+      // A full UART buffer means the core will have thrown away anything that arrived
+      // since it filled (if anything did -- there's no way to tell)
+      if( uartLimit && (size_t)available >= uartLimit )
+        uartFullTimes++;
+
+      // If the ring is full, leave the rest in the UART's own buffer rather than dropping it
+      size_t count = min( (size_t)available, (size_t)space() );
+
+      for( size_t i = 0; i < count; i++ )
+        receive( sensorUART->read() );
+
+      return count;
+    }
+
+    /**
+     * @brief Number of bytes dropped because the ring was full when `receive()` was called
+     */
+    uint32_t overruns( void )
+    {
+      return loadCount( overrunCount );
+    }
+
+    /**
+     * @brief Number of times `poll()` found the UART's own buffer full, meaning the core may
+     *        have dropped bytes before they got to the ring
+     *
+     * @note Always 0 unless the constructor was given `uartBufferSize`
+     */
+    uint32_t uartFullCount( void )
+    {
+      return loadCount( uartFullTimes );
+    }
+
+    /**
+     * @brief Reset both `overruns()` and `uartFullCount()` to zero
+     */
+    void clearOverruns( void )
+    {
+      #ifdef __AVR__
+        ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+      #endif
+      {
+        overrunCount = 0;
+        uartFullTimes = 0;
+      }
+    }
+
+    int available( void )
+    {
+      if( polled )
+        poll();
+
+      return ( loadHead() - tail ) & mask;
+    }
+
+    int peek( void )
+    {
+      if( loadHead() == tail && ( !polled || !poll() || loadHead() == tail ) )
+        return -1;
+
+      barrier();
+      return buffer[tail];
+    }
+
+    int read( void )
+    {
+      // Only go to the UART when the ring runs dry, to keep reads cheap
+      if( loadHead() == tail && ( !polled || !poll() || loadHead() == tail ) )
+        return -1;
+
+      barrier();
+      uint8_t c = buffer[tail];
+      storeTail( ( tail + 1 ) & mask );
+
+      return c;
+    }
+
+    size_t write( uint8_t c )
+    {
+      return sensorUART->write( c );
+    }
+
+    size_t write( const uint8_t *data, size_t length )
+    {
+      return sensorUART->write( data, length );
+    }
+
+    using Print::write;
+
+    void flush( void )
+    {
+      sensorUART->flush();
+    }
+
+  private:
+
+    typedef typename DFR_RadarRxBufferIndex<( Size <= 256 )>::type Index;
+
+    static const Index mask = Size - 1;
+
+    Index space( void )
+    {
+      return ( loadTail() - head - 1 ) & mask;
+    }
+
+    /**
+     * @brief Make sure the byte is in the ring before the index that publishes it (and vice versa)
+     */
+    static inline void barrier( void )
+    {
+      #ifdef __AVR__
+        __asm__ __volatile__( "" ::: "memory" );
+      #else
+        __sync_synchronize();
+      #endif
+    }
+
+    /**
+     * @brief `head` and `tail` can each be changed by the other side at any time, so on AVR
+     *        (where a 16-bit load is two instructions) they have to be read with interrupts off
+     */
+    Index loadHead( void )
+    {
+      Index index;
+
+      #ifdef __AVR__
+        if( sizeof( Index ) > 1 )
+        {
+          ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+          {
+            index = head;
+          }
+
+          return index;
+        }
+      #endif
+
+      index = head;
+      return index;
+    }
+
+    Index loadTail( void )
+    {
+      Index index;
+
+      #ifdef __AVR__
+        if( sizeof( Index ) > 1 )
+        {
+          ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+          {
+            index = tail;
+          }
+
+          return index;
+        }
+      #endif
+
+      index = tail;
+      return index;
+    }
+
+    /**
+     * @brief The counters are also changed by the producer, and are four bytes wide
+     */
+    static uint32_t loadCount( volatile uint32_t &counter )
+    {
+      uint32_t count;
+
+      #ifdef __AVR__
+        ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+      #endif
+      {
+        count = counter;
+      }
+
+      return count;
+    }
+
+    void storeTail( Index index )
+    {
+      #ifdef __AVR__
+        if( sizeof( Index ) > 1 )
+        {
+          ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+          {
+            tail = index;
+          }
+
+          return;
+        }
+      #endif
+
+      tail = index;
+    }
+
+    Stream *sensorUART;
+    bool polled;
+    size_t uartLimit;
+
+    uint8_t buffer[Size];
+
+    // `head` is only written by the producer (`receive()`), `tail` only by the consumer (`read()`)
+    volatile Index head;
+    volatile Index tail;
+    volatile uint32_t overrunCount;
+    volatile uint32_t uartFullTimes;
+};
+
+#endif